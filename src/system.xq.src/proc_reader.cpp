@@ -0,0 +1,218 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include "proc_reader.h"
+
+
+namespace zorba { namespace system {
+
+  const size_t StringRef::npos;
+
+  static bool isBlank(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  bool StringRef::operator==(const char* aStr) const
+  {
+    size_t lLen = strlen(aStr);
+    return lLen == theSize && memcmp(theData, aStr, lLen) == 0;
+  }
+
+  bool StringRef::startsWith(const char* aPrefix) const
+  {
+    size_t lLen = strlen(aPrefix);
+    return lLen <= theSize && memcmp(theData, aPrefix, lLen) == 0;
+  }
+
+  size_t StringRef::find(char aChar) const
+  {
+    const void* lPos = memchr(theData, aChar, theSize);
+    return lPos ? static_cast<const char*>(lPos) - theData : npos;
+  }
+
+  StringRef StringRef::substr(size_t aPos, size_t aSize) const
+  {
+    if (aPos > theSize)
+      aPos = theSize;
+    if (aSize > theSize - aPos)
+      aSize = theSize - aPos;
+    return StringRef(theData + aPos, aSize);
+  }
+
+  StringRef StringRef::trim() const
+  {
+    size_t lBegin = 0;
+    size_t lEnd = theSize;
+    while (lBegin < lEnd && isBlank(theData[lBegin]))
+      ++lBegin;
+    while (lEnd > lBegin && isBlank(theData[lEnd - 1]))
+      --lEnd;
+    return StringRef(theData + lBegin, lEnd - lBegin);
+  }
+
+  bool StringRef::toLong(long& aValue) const
+  {
+    size_t i = 0;
+    bool lNegative = false;
+    if (i < theSize && theData[i] == '-') {
+      lNegative = true;
+      ++i;
+    }
+    if (i == theSize || theData[i] < '0' || theData[i] > '9')
+      return false;
+    long lValue = 0;
+    for (; i < theSize && theData[i] >= '0' && theData[i] <= '9'; ++i)
+      lValue = lValue * 10 + (theData[i] - '0');
+    aValue = lNegative ? -lValue : lValue;
+    return true;
+  }
+
+  ProcReader::ProcReader()
+    : theBuffer(4096), theSize(0), thePos(0)
+  {
+  }
+
+  bool ProcReader::read(const char* aPath)
+  {
+    theSize = 0;
+    thePos = 0;
+#ifdef WIN32
+    return false;
+#else
+    int lFd = open(aPath, O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+      return false;
+    // pseudo files report a size of 0, and seq_files (e.g. /proc/cpuinfo)
+    // return short reads, typically a page at a time, long before the end;
+    // only a read of 0 bytes marks the end of the file
+    for (;;) {
+      if (theSize == theBuffer.size())
+        theBuffer.resize(theBuffer.size() * 2);
+      ssize_t lRead = pread(lFd, &theBuffer[theSize], theBuffer.size() - theSize, theSize);
+      if (lRead < 0) {
+        if (errno == EINTR)
+          continue;
+        close(lFd);
+        return false;
+      }
+      if (lRead == 0)
+        break;
+      theSize += lRead;
+    }
+    close(lFd);
+    return true;
+#endif
+  }
+
+  bool ProcReader::read(int aFd)
+  {
+    theSize = 0;
+    thePos = 0;
+#ifdef WIN32
+    return false;
+#else
+    for (;;) {
+      if (theSize == theBuffer.size())
+        theBuffer.resize(theBuffer.size() * 2);
+      ssize_t lRead = ::read(aFd, &theBuffer[theSize], theBuffer.size() - theSize);
+      if (lRead < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      if (lRead == 0)
+        break;
+      theSize += lRead;
+    }
+    return true;
+#endif
+  }
+
+  bool ProcReader::nextLine(StringRef& aLine)
+  {
+    if (thePos >= theSize)
+      return false;
+    const char* lBegin = &theBuffer[thePos];
+    const void* lEnd = memchr(lBegin, '\n', theSize - thePos);
+    size_t lLen = lEnd ? static_cast<const char*>(lEnd) - lBegin : theSize - thePos;
+    aLine = StringRef(lBegin, lLen);
+    thePos += lLen + 1;
+    return true;
+  }
+
+  bool ProcReader::nextKeyValue(char aSep, StringRef& aKey, StringRef& aValue)
+  {
+    StringRef lLine;
+    if (!nextLine(lLine))
+      return false;
+    size_t lSep = lLine.find(aSep);
+    if (lSep == StringRef::npos) {
+      aKey = lLine.trim();
+      aValue = StringRef();
+    } else {
+      aKey = lLine.substr(0, lSep).trim();
+      aValue = lLine.substr(lSep + 1).trim();
+    }
+    return true;
+  }
+
+  bool ProcReader::nextColumn(StringRef& aLine, StringRef& aColumn)
+  {
+    const char* lData = aLine.data();
+    size_t lSize = aLine.size();
+    size_t lBegin = 0;
+    while (lBegin < lSize && isBlank(lData[lBegin]))
+      ++lBegin;
+    if (lBegin == lSize) {
+      aLine = StringRef();
+      return false;
+    }
+    size_t lEnd = lBegin;
+    while (lEnd < lSize && !isBlank(lData[lEnd]))
+      ++lEnd;
+    aColumn = StringRef(lData + lBegin, lEnd - lBegin);
+    aLine = StringRef(lData + lEnd, lSize - lEnd);
+    return true;
+  }
+
+  bool countProcessors(ProcReader& aReader, const char* aPath, CpuinfoCounts& aCounts)
+  {
+    if (!aReader.read(aPath))
+      return false;
+    StringRef name;
+    StringRef value;
+    long lCores;
+
+    while (aReader.nextKeyValue(':', name, value)) {
+      if (name == "processor") {
+        aCounts.logical++;
+      } else if (name == "cpu cores" && value.toLong(lCores) && lCores > 0) {
+        aCounts.cores = lCores;
+      }
+    }
+    aCounts.physical = aCounts.logical/aCounts.cores;
+    return true;
+  }
+
+}} // namespace zorba, system
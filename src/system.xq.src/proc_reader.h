@@ -0,0 +1,102 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COM_ZORBA_WWW_MODULES_SYSTEM_PROC_READER_H__
+#define __COM_ZORBA_WWW_MODULES_SYSTEM_PROC_READER_H__
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace zorba { namespace system {
+
+  // A non-owning view into a character buffer, e.g. the one of a ProcReader.
+  // It stays valid until the buffer is read into again.
+  class StringRef {
+    private:
+      const char* theData;
+      size_t theSize;
+    public:
+      StringRef() : theData(0), theSize(0) {}
+      StringRef(const char* aData, size_t aSize) : theData(aData), theSize(aSize) {}
+
+      const char* data() const { return theData; }
+      size_t size() const { return theSize; }
+      bool empty() const { return theSize == 0; }
+      std::string str() const { return std::string(theData, theSize); }
+
+      bool operator==(const char* aStr) const;
+      bool operator!=(const char* aStr) const { return !(*this == aStr); }
+      bool startsWith(const char* aPrefix) const;
+
+      // returns npos if aChar is not found
+      size_t find(char aChar) const;
+      StringRef substr(size_t aPos, size_t aSize = npos) const;
+      // strips blanks, tabs and line breaks from both ends
+      StringRef trim() const;
+      // parses a leading decimal number, returns false if there is none
+      bool toLong(long& aValue) const;
+
+      static const size_t npos = static_cast<size_t>(-1);
+  };
+
+  // Reads small pseudo files, as found in /proc and /sys, with pread into a
+  // buffer that is reused between reads, and tokenizes the content in place.
+  // None of the tokenizers allocate; they return views into the buffer.
+  class ProcReader {
+    private:
+      std::vector<char> theBuffer;
+      size_t theSize;
+      size_t thePos;
+
+      ProcReader(const ProcReader&);
+      ProcReader& operator=(const ProcReader&);
+    public:
+      ProcReader();
+
+      // replaces the buffer with the content of the file at aPath
+      bool read(const char* aPath);
+      // replaces the buffer with everything that can be read from aFd,
+      // e.g. the output of a pipe
+      bool read(int aFd);
+
+      StringRef content() const { return StringRef(&theBuffer[0], theSize); }
+
+      // line by line iteration over the content
+      bool nextLine(StringRef& aLine);
+      // iterates over "key<aSep>value" lines, both sides trimmed; lines
+      // without a separator are returned with an empty value
+      bool nextKeyValue(char aSep, StringRef& aKey, StringRef& aValue);
+      // splits the next whitespace separated column off aLine
+      static bool nextColumn(StringRef& aLine, StringRef& aColumn);
+  };
+
+  // The processor counts of a /proc/cpuinfo formatted file, as reported by
+  // the hardware.*.cpu properties.
+  struct CpuinfoCounts {
+    int logical;
+    int cores;
+    int physical;
+
+    // per default: single core processor
+    CpuinfoCounts() : logical(0), cores(1), physical(0) {}
+  };
+
+  // returns false if aPath cannot be read
+  bool countProcessors(ProcReader& aReader, const char* aPath, CpuinfoCounts& aCounts);
+
+} } // namespace zorba, namespace system
+
+#endif // __COM_ZORBA_WWW_MODULES_SYSTEM_PROC_READER_H__
@@ -15,6 +15,7 @@
  */
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 
 #ifdef WIN32
@@ -25,6 +26,8 @@
 # include <winreg.h>
 #else
 #include <sys/utsname.h>
+#include <sys/resource.h>
+#include <unistd.h>
 # ifndef __APPLE__
 #   include <sys/sysinfo.h>
 # else
@@ -41,48 +44,24 @@
 
 
 #ifdef LINUX
-#include <iostream>
 #include <string>
-#include <fstream>
-#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/syscall.h>
 extern char** environ;
 #elif defined APPLE
 # include <crt_externs.h>
 #endif
 
 #include "system.h"
+#include "proc_reader.h"
 
 
 namespace zorba { namespace system {
 
   const String SystemModule::SYSTEM_MODULE_NAMESPACE = "http://zorba.io/modules/system";
 
-  // global keys
-  zorba::Item SystemModule::globalOSName;
-  zorba::Item SystemModule::globalOSNodeName;
-  zorba::Item SystemModule::globalOSVersionMajor;
-  zorba::Item SystemModule::globalOSVersionMinor;
-  zorba::Item SystemModule::globalOSVersionBuild;
-  zorba::Item SystemModule::globalOSVersionRelease;
-  zorba::Item SystemModule::globalOSVersionVersion;
-  zorba::Item SystemModule::globalOSVersion;
-  zorba::Item SystemModule::globalOSArch;
-  zorba::Item SystemModule::globalOSis64;
-  zorba::Item SystemModule::globalHWLogicalCPU;
-  zorba::Item SystemModule::globalHWPhysicalCPU;
-  zorba::Item SystemModule::globalHWLogicalPerPhysicalCPU;
-  zorba::Item SystemModule::globalHWPhysicalMemory;
-  zorba::Item SystemModule::globalHWVirtualMemory;
-  zorba::Item SystemModule::globalHWManufacturer;
-  zorba::Item SystemModule::globalLinuxDistributor;
-  zorba::Item SystemModule::globalLinuxDistributorVersion;
-  zorba::Item SystemModule::globalUserName;
-  zorba::Item SystemModule::globalZorbaModulePath;
-  zorba::Item SystemModule::globalZorbaVersion;
-  zorba::Item SystemModule::globalZorbaVersionMajor;
-  zorba::Item SystemModule::globalZorbaVersionMinor;
-  zorba::Item SystemModule::globalZorbaVersionPatch;
-
 #ifdef WIN32
   typedef BOOL (WINAPI *LPFN_GLPI)(
       PSYSTEM_LOGICAL_PROCESSOR_INFORMATION,
@@ -104,14 +83,22 @@ namespace zorba { namespace system {
     return bitSetCount;
   }
 
-  DWORD numaNodeCount = 0;
-  DWORD processorPackageCount = 0;
-  DWORD logicalProcessorCount = 0;
-  DWORD processorCoreCount = 0;
-  DWORD processorL1CacheCount = 0;
-  DWORD processorL2CacheCount = 0;
-  DWORD processorL3CacheCount = 0;
-  static void countProcessors() {
+  struct ProcessorCounts {
+    DWORD numaNodeCount;
+    DWORD processorPackageCount;
+    DWORD logicalProcessorCount;
+    DWORD processorCoreCount;
+    DWORD processorL1CacheCount;
+    DWORD processorL2CacheCount;
+    DWORD processorL3CacheCount;
+
+    ProcessorCounts()
+      : numaNodeCount(0), processorPackageCount(0), logicalProcessorCount(0),
+        processorCoreCount(0), processorL1CacheCount(0), processorL2CacheCount(0),
+        processorL3CacheCount(0) {}
+  };
+
+  static void countProcessors(ProcessorCounts& aCounts) {
     LPFN_GLPI glpi;
     BOOL done = FALSE;
     PSYSTEM_LOGICAL_PROCESSOR_INFORMATION buffer = NULL;
@@ -156,12 +143,12 @@ namespace zorba { namespace system {
       {
         case RelationNumaNode:
           // Non-NUMA systems report a single record of this type.
-          numaNodeCount++;
+          aCounts.numaNodeCount++;
           break;
         case RelationProcessorCore:
-          processorCoreCount++;
+          aCounts.processorCoreCount++;
           // A hyperthreaded core supplies more than one logical processor.
-          logicalProcessorCount += CountSetBits(ptr->ProcessorMask);
+          aCounts.logicalProcessorCount += CountSetBits(ptr->ProcessorMask);
           break;
 
         case RelationCache:
@@ -169,20 +156,20 @@ namespace zorba { namespace system {
           Cache = &ptr->Cache;
           if (Cache->Level == 1)
           {
-            processorL1CacheCount++;
+            aCounts.processorL1CacheCount++;
           }
           else if (Cache->Level == 2)
           {
-            processorL2CacheCount++;
+            aCounts.processorL2CacheCount++;
           }
           else if (Cache->Level == 3)
           {
-            processorL3CacheCount++;
+            aCounts.processorL3CacheCount++;
           }
           break;
         case RelationProcessorPackage:
           // Logical processors share a physical package.
-          processorPackageCount++;
+          aCounts.processorPackageCount++;
           break;
         default:
           // Error: Unsupported LOGICAL_PROCESSOR_RELATIONSHIP value.
@@ -198,121 +185,129 @@ namespace zorba { namespace system {
 #endif
 
 #ifdef LINUX
-  static void trim(std::string& str, char delim)
-  {
-    std::string::size_type pos = str.find_last_not_of(delim);
-    if(pos != std::string::npos) {
-      str.erase(pos + 1);
-      pos = str.find_first_not_of(delim);
-      if(pos != std::string::npos) str.erase(0, pos);
-    }
-    else str.erase(str.begin(), str.end());
+  static bool readLong(ProcReader& aReader, const char* aPath, long& aValue) {
+    StringRef lLine;
+    return aReader.read(aPath) && aReader.nextLine(lLine) && lLine.trim().toLong(aValue);
   }
 
+  // the active mode of a sysfs selection, e.g. "always [madvise] never"
+  static bool readSelection(ProcReader& aReader, const char* aPath, std::string& aValue) {
+    StringRef lLine;
+    if (!aReader.read(aPath) || !aReader.nextLine(lLine))
+      return false;
+    size_t lStart = lLine.find('[');
+    size_t lEnd = lLine.find(']');
+    if (lStart == StringRef::npos || lEnd == StringRef::npos || lEnd < lStart)
+      aValue = lLine.trim().str();
+    else
+      aValue = lLine.substr(lStart + 1, lEnd - lStart - 1).str();
+    return true;
+  }
 
-  int logical=0;
-  int cores=0;
-  int physical=0;
-
-
-  static void countProcessors() {
-    logical=0;
-    cores=1; // per default: single core processor
-    physical=0;
-
-    std::ifstream in("/proc/cpuinfo");
-    if(in) {
-      std::string name;
-      std::string value;
-
-      while(in) {
-        getline(in, name, ':');
-        trim (name, ' ');
-        trim (name, '\t');
-        trim (name, '\n');
-        getline(in, value);
-        trim (value, ' ');
-        trim (value, '\t');
-        if (name == "processor") {
-          logical++;
-        }
-
-        if (name == "cpu cores") {
-          cores = atoi(value.c_str());
-        }
+  struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+  };
+
+  // counts the open file descriptors of this process; /proc/self/fd is
+  // read with getdents64 directly, which avoids a readdir/stat round trip
+  // per descriptor
+  static long countOpenFiles() {
+    int lFd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (lFd < 0)
+      return -1;
+    long lBuf[1024];
+    long lCount = 0;
+    for (;;) {
+      long lRead = syscall(SYS_getdents64, lFd, lBuf, sizeof(lBuf));
+      if (lRead < 0) {
+        close(lFd);
+        return -1;
+      }
+      if (lRead == 0)
+        break;
+      for (long lPos = 0; lPos < lRead; ) {
+        linux_dirent64* lEntry = reinterpret_cast<linux_dirent64*>(reinterpret_cast<char*>(lBuf) + lPos);
+        if (lEntry->d_name[0] != '.')
+          ++lCount;
+        lPos += lEntry->d_reclen;
       }
-      physical = logical/cores;
-      in.close();
     }
+    close(lFd);
+    // don't count the descriptor used for the listing itself
+    return lCount - 1;
   }
 
-
-
-  static std::pair<std::string, std::string> getDistribution() {
+  static std::pair<std::string, std::string> getDistribution(ProcReader& aReader) {
     std::pair<std::string, std::string> lRes;
     FILE *pipe;
     const char* command = "lsb_release -r -i";
     pipe = (FILE*) popen(command, "r");
-
-    char line[1024];
-    while (fgets(line, sizeof(line), pipe)) {
-      std::stringstream s(line);
-      std::string name, value;
-      getline(s, name, ':');
-      trim(name, ' ');
-      trim(name, '\t');
-      getline(s, value, ':');
-      trim(value, ' ');
-      trim(value, '\t');
-      trim(value, '\n');
-      if (name == "Distributor ID") {
-        lRes.first = value;
-      } else {
-        lRes.second = value;
+    if (!pipe)
+      return lRes;
+
+    if (aReader.read(fileno(pipe))) {
+      StringRef name;
+      StringRef value;
+      while (aReader.nextKeyValue(':', name, value)) {
+        if (name.empty())
+          continue;
+        if (name == "Distributor ID") {
+          lRes.first = value.str();
+        } else {
+          lRes.second = value.str();
+        }
       }
     }
+    pclose(pipe);
     return lRes;
   }
 #endif
 
+  // the names of the global keys, in the order of SystemModule::GLOBAL_KEY
+  static const char* const GLOBAL_KEY_NAMES[] = {
+    "os.name", "os.node.name", "os.version.major", "os.version.minor",
+    "os.version.build", "os.version.release", "os.version.version", "os.version",
+    "os.arch", "os.is64", "hardware.logical.cpu", "hardware.physical.cpu",
+    "hardware.logical.per.physical.cpu", "hardware.physical.memory",
+    "hardware.virtual.memory", "hardware.manufacturer",
+    "hardware.memory.page.size", "hardware.memory.transparent.hugepages",
+    "hardware.memory.transparent.hugepages.defrag",
+    "hardware.memory.overcommit", "hardware.memory.overcommit.ratio",
+    "hardware.memory.swappiness", "hardware.memory.numa.balancing", "linux.distributor",
+    "linux.distributor.version", "user.name", "zorba.module.path", "zorba.version", "zorba.version.major",
+    "zorba.version.minor", "zorba.version.patch"
+  };
+  typedef char GLOBAL_KEY_NAMES_MATCH_GLOBAL_KEY[
+      sizeof(GLOBAL_KEY_NAMES) / sizeof(GLOBAL_KEY_NAMES[0]) == SystemModule::GLOBAL_KEY_COUNT ? 1 : -1];
+
   SystemModule::SystemModule()
-    : thePropertyFunction(0), thePropertiesFunction(0)
+    : theFactory(Zorba::getInstance(0)->getItemFactory())
   {
-      globalOSName = Zorba::getInstance(0)->getItemFactory()->createString("os.name");
-      globalOSNodeName = Zorba::getInstance(0)->getItemFactory()->createString("os.node.name");
-      globalOSVersionMajor = Zorba::getInstance(0)->getItemFactory()->createString("os.version.major");
-      globalOSVersionMinor = Zorba::getInstance(0)->getItemFactory()->createString("os.version.minor");
-      globalOSVersionBuild = Zorba::getInstance(0)->getItemFactory()->createString("os.version.build");
-      globalOSVersionRelease = Zorba::getInstance(0)->getItemFactory()->createString("os.version.release");
-      globalOSVersionVersion = Zorba::getInstance(0)->getItemFactory()->createString("os.version.version");
-      globalOSVersion = Zorba::getInstance(0)->getItemFactory()->createString("os.version");
-      globalOSArch = Zorba::getInstance(0)->getItemFactory()->createString("os.arch");
-      globalOSis64 = Zorba::getInstance(0)->getItemFactory()->createString("os.is64");
-      globalHWLogicalCPU = Zorba::getInstance(0)->getItemFactory()->createString("hardware.logical.cpu");
-      globalHWPhysicalCPU = Zorba::getInstance(0)->getItemFactory()->createString("hardware.physical.cpu");
-      globalHWLogicalPerPhysicalCPU = Zorba::getInstance(0)->getItemFactory()->createString("hardware.logical.per.physical.cpu");
-      globalHWPhysicalMemory = Zorba::getInstance(0)->getItemFactory()->createString("hardware.physical.memory");
-      globalHWVirtualMemory = Zorba::getInstance(0)->getItemFactory()->createString("hardware.virtual.memory");
-      globalHWManufacturer = Zorba::getInstance(0)->getItemFactory()->createString("hardware.manufacturer");
-      globalLinuxDistributor = Zorba::getInstance(0)->getItemFactory()->createString("linux.distributor");
-      globalLinuxDistributorVersion = Zorba::getInstance(0)->getItemFactory()->createString("linux.distributor.version");
-      globalUserName = Zorba::getInstance(0)->getItemFactory()->createString("user.name");
-      globalZorbaModulePath = Zorba::getInstance(0)->getItemFactory()->createString("zorba.module.path");
-      globalZorbaVersion = Zorba::getInstance(0)->getItemFactory()->createString("zorba.version");
-      globalZorbaVersionMajor = Zorba::getInstance(0)->getItemFactory()->createString("zorba.version.major");
-      globalZorbaVersionMinor = Zorba::getInstance(0)->getItemFactory()->createString("zorba.version.minor");
-      globalZorbaVersionPatch = Zorba::getInstance(0)->getItemFactory()->createString("zorba.version.patch");
+    for (int i = 0; i < GLOBAL_KEY_COUNT; ++i)
+      theGlobalKeys[i] = theFactory->createString(GLOBAL_KEY_NAMES[i]);
+    initProperties();
+
+    // the functions are created upfront, such that getExternalFunction
+    // can be called concurrently; they share the property table
+    thePropertyFunction = new PropertyFunction(this);
+    thePropertiesFunction = new PropertiesFunction(this);
+    theTypedPropertyFunction = new TypedPropertyFunction(this);
+    theLimitsFunction = new LimitsFunction(this);
   }
 
   ExternalFunction* SystemModule::getExternalFunction(const String& localName) {
     if (localName == "properties") {
-      if (!thePropertiesFunction)
-        thePropertiesFunction = new PropertiesFunction(this);
       return thePropertiesFunction;
     } else if (localName == "property") {
-      if (!thePropertyFunction)
-        thePropertyFunction = new PropertyFunction(this);
       return thePropertyFunction;
+    } else if (localName == "limits") {
+      return theLimitsFunction;
+    } else if (localName == "typed-property") {
+      return theTypedPropertyFunction;
     }
     return 0;
   }
@@ -324,44 +319,11 @@ namespace zorba { namespace system {
   SystemModule::~SystemModule() {
     delete thePropertyFunction;
     delete thePropertiesFunction;
+    delete theTypedPropertyFunction;
+    delete theLimitsFunction;
   }
 
-  zorba::Item&
-  SystemModule::getGlobalKey(SystemModule::GLOBAL_KEY g)
-  {
-      switch(g)
-      {
-      case OS_NAME: return globalOSName;
-      case OS_NODE_NAME: return globalOSNodeName;
-      case OS_VER_MAJOR: return globalOSVersionMajor;
-      case OS_VER_MINOR: return globalOSVersionMinor;
-      case OS_VER_BUILD: return globalOSVersionBuild;
-      case OS_VER_RELEASE: return globalOSVersionRelease;
-      case OS_VER_VERSION: return globalOSVersionVersion;
-      case OS_VER: return globalOSVersion;
-      case OS_ARCH: return globalOSArch;
-      case OS_IS64: return globalOSis64;
-      case HARDWARE_lOGICAL_CPU: return globalHWLogicalCPU;
-      case HARDWARE_PHYSICAL_CPU: return globalHWPhysicalCPU;
-      case HARDWARE_LOGICAL_PER_PHYSICAL_CPU: return globalHWLogicalPerPhysicalCPU;
-      case HARDWARE_PHYSICAL_MEMORY: return globalHWPhysicalMemory;
-      case HARDWARE_VIRTUAL_MEMORY: return globalHWVirtualMemory;
-      case HARDWARE_MANUFACTURER: return globalHWManufacturer;
-      case LINUX_DISTRIBUTOR: return globalLinuxDistributor;
-      case LINUX_DISTRIBUTOR_VERSION: return globalLinuxDistributorVersion;
-      case USER_NAME: return globalUserName;
-      case ZORBA_MODULE_PATH: return globalZorbaModulePath;
-      case ZORBA_VER: return globalZorbaVersion;
-      case ZORBA_VER_MAJOR: return globalZorbaVersionMajor;
-      case ZORBA_VER_MINOR: return globalZorbaVersionMinor;
-      case ZORBA_VER_PATCH: return globalZorbaVersionPatch;
-      // should never hit this code but still ...
-      default: return globalOSName;
-      }
-  }
-
-  SystemFunction::SystemFunction(const ExternalModule* aModule)
-    : theModule(aModule), theFactory(Zorba::getInstance(0)->getItemFactory())
+  void SystemModule::initProperties()
   {
 #ifdef WIN32
 
@@ -374,7 +336,7 @@ namespace zorba { namespace system {
         nodeNameC[i] = static_cast<char>(nodeName[i]);
       }
       nodeNameC[nodeNameLength] = NULL;  // Terminate string
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_NODE_NAME).getStringValue(), nodeNameC));
+      addProperty(SystemModule::OS_NODE_NAME, nodeNameC);
     }
 
     {
@@ -393,50 +355,29 @@ namespace zorba { namespace system {
       if (dwVersion < 0x80000000)
         dwBuild = (DWORD)(HIWORD(dwVersion));
 
-      std::string major;
-      std::string minor;
-      std::string build;
-      {
-        std::stringstream sMajor;
-        sMajor << dwMajorVersion;
-        std::stringstream sMinor;
-        sMinor << dwMinorVersion;
-        std::stringstream sBuild;
-        sBuild << dwBuild;
-
-        major = sMajor.str();
-        minor = sMinor.str();
-        build = sBuild.str();
-      }
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER_MAJOR).getStringValue(), major));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER_MINOR).getStringValue(), minor));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER_BUILD).getStringValue(), build));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER).getString(), major + "." + minor + "." + build));
+      std::stringstream lVersion;
+      lVersion << dwMajorVersion << "." << dwMinorVersion << "." << dwBuild;
+      addProperty(SystemModule::OS_VER_MAJOR, theFactory->createInteger(dwMajorVersion));
+      addProperty(SystemModule::OS_VER_MINOR, theFactory->createInteger(dwMinorVersion));
+      addProperty(SystemModule::OS_VER_BUILD, theFactory->createInteger(dwBuild));
+      addProperty(SystemModule::OS_VER, lVersion.str());
       // http://msdn.microsoft.com/en-us/library/ms724832(v=VS.85).aspx
       std::string operativeSystem;
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_NAME).getStringValue(), "Windows"));
+      addProperty(SystemModule::OS_NAME, "Windows");
       {
-        countProcessors();
-        std::stringstream logicalProcessors;
-        logicalProcessors << processorPackageCount;
-        std::stringstream physicalProcessors;
-        physicalProcessors << logicalProcessorCount;
-        std::stringstream logicalPerPhysicalProcessors;
-        logicalPerPhysicalProcessors << (logicalProcessorCount / processorPackageCount );
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_CPU).getStringValue(), logicalProcessors.str() ));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_lOGICAL_CPU).getStringValue(), physicalProcessors.str() ));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_LOGICAL_PER_PHYSICAL_CPU).getStringValue(), logicalPerPhysicalProcessors.str() ));
+        ProcessorCounts lCounts;
+        countProcessors(lCounts);
+        addProperty(SystemModule::HARDWARE_PHYSICAL_CPU, theFactory->createInteger(lCounts.processorPackageCount));
+        addProperty(SystemModule::HARDWARE_lOGICAL_CPU, theFactory->createInteger(lCounts.logicalProcessorCount));
+        if (lCounts.processorPackageCount > 0)
+          addProperty(SystemModule::HARDWARE_LOGICAL_PER_PHYSICAL_CPU, theFactory->createInteger(lCounts.logicalProcessorCount / lCounts.processorPackageCount));
       }
       {
         MEMORYSTATUSEX statex;
         statex.dwLength = sizeof (statex);
         GlobalMemoryStatusEx (&statex);
-        std::stringstream virtualMemory;
-        virtualMemory << statex.ullTotalVirtual;
-        std::stringstream physicalMemory;
-        physicalMemory << statex.ullTotalPhys;
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_VIRTUAL_MEMORY).getStringValue(), virtualMemory.str() ));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_MEMORY).getStringValue(), physicalMemory.str() ));
+        addProperty(SystemModule::HARDWARE_VIRTUAL_MEMORY, theFactory->createInteger(statex.ullTotalVirtual));
+        addProperty(SystemModule::HARDWARE_PHYSICAL_MEMORY, theFactory->createInteger(statex.ullTotalPhys));
       }
 
     }
@@ -448,20 +389,21 @@ namespace zorba { namespace system {
       for (DWORD i = 0; i < userNameLength; ++i) {
         userNameC[i] = static_cast<char>(userName[i]);
       }
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::USER_NAME).getStringValue(), userNameC));
+      addProperty(SystemModule::USER_NAME, userNameC);
     }
     {
       SYSTEM_INFO info;
       GetSystemInfo(&info);
+      addProperty(SystemModule::HARDWARE_MEMORY_PAGE_SIZE, theFactory->createInteger(info.dwPageSize));
       if (info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_AMD64) {
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_ARCH).getStringValue(), "x86_64"));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_IS64).getStringValue(), "true"));
+        addProperty(SystemModule::OS_ARCH, "x86_64");
+        addProperty(SystemModule::OS_IS64, theFactory->createBoolean(true));
       } else if (info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_IA64) {
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_ARCH).getStringValue(), "ia64"));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_IS64).getStringValue(), "true"));
+        addProperty(SystemModule::OS_ARCH, "ia64");
+        addProperty(SystemModule::OS_IS64, theFactory->createBoolean(true));
       } else if (info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_INTEL) {
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_ARCH).getStringValue(), "i386"));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_IS64).getStringValue(), "false"));
+        addProperty(SystemModule::OS_ARCH, "i386");
+        addProperty(SystemModule::OS_IS64, theFactory->createBoolean(false));
       }
     }
 
@@ -478,7 +420,7 @@ namespace zorba { namespace system {
           valueC[i] = static_cast<char>(value[i]);
         }
         if (size > 0)
-          theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_MANUFACTURER).getStringValue(), valueC));
+          addProperty(SystemModule::HARDWARE_MANUFACTURER, valueC);
       }
       RegCloseKey(keyHandle);
     }
@@ -486,21 +428,25 @@ namespace zorba { namespace system {
 
 #else
     struct utsname osname;
+    // a 64 bit process implies a 64 bit system; a 32 bit one doesn't tell
+    bool lIs64 = sizeof(void*) == 8;
     if (uname(&osname) == 0)
     {
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_NAME).getStringValue(), osname.sysname));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_NODE_NAME).getStringValue(), osname.nodename));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER_RELEASE).getStringValue(), osname.release));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER_VERSION).getStringValue(), osname.version));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_VER).getStringValue(), osname.release));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_ARCH).getStringValue(), osname.machine));
+      addProperty(SystemModule::OS_NAME, osname.sysname);
+      addProperty(SystemModule::OS_NODE_NAME, osname.nodename);
+      addProperty(SystemModule::OS_VER_RELEASE, osname.release);
+      addProperty(SystemModule::OS_VER_VERSION, osname.version);
+      addProperty(SystemModule::OS_VER, osname.release);
+      addProperty(SystemModule::OS_ARCH, osname.machine);
+      // e.g. x86_64, aarch64, ppc64le, sparc64 or s390x
+      lIs64 = lIs64 || strstr(osname.machine, "64") != NULL || strcmp(osname.machine, "s390x") == 0;
     }
     char* lUser = getenv("USER");
     if (lUser)
     {
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::USER_NAME).getStringValue(), lUser));
+      addProperty(SystemModule::USER_NAME, lUser);
     }
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::OS_IS64).getStringValue(), "false"));
+    addProperty(SystemModule::OS_IS64, theFactory->createBoolean(lIs64));
     {
 #ifdef __APPLE__
       int mib[2];
@@ -510,33 +456,24 @@ namespace zorba { namespace system {
       mib[0] = CTL_HW;
       mib[1] = HW_NCPU;
       sysctl(mib, 2, &res, &len, NULL, NULL);
-      std::stringstream lStream;
-      lStream << res;
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_CPU).getStringValue(), lStream.str()));
+      addProperty(SystemModule::HARDWARE_PHYSICAL_CPU, theFactory->createInteger(res));
 #else
-      countProcessors();
-      std::stringstream logicalProcessor;
-      std::stringstream physicalProcessor;
-      std::stringstream logicalPerPhysicalProcessors;
-      logicalProcessor << logical;
-      physicalProcessor << physical;
-      logicalPerPhysicalProcessors << cores;
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_LOGICAL_PER_PHYSICAL_CPU).getStringValue(), logicalPerPhysicalProcessors.str() ));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_CPU).getStringValue(), physicalProcessor.str() ));
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_lOGICAL_CPU).getStringValue(), logicalProcessor.str() ));
+      ProcReader lReader;
+      CpuinfoCounts lCounts;
+      countProcessors(lReader, "/proc/cpuinfo", lCounts);
+      addProperty(SystemModule::HARDWARE_LOGICAL_PER_PHYSICAL_CPU, theFactory->createInteger(lCounts.cores));
+      addProperty(SystemModule::HARDWARE_PHYSICAL_CPU, theFactory->createInteger(lCounts.physical));
+      addProperty(SystemModule::HARDWARE_lOGICAL_CPU, theFactory->createInteger(lCounts.logical));
 #endif
     }
     {
 # ifdef LINUX
       struct sysinfo sys_info;
       if(sysinfo(&sys_info) == 0) {
-        std::stringstream memory;
-        memory << sys_info.totalram;
-        std::stringstream swap;
-        swap << sys_info.totalswap;
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_VIRTUAL_MEMORY).getStringValue(), swap.str() ));
-        theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_MEMORY).getStringValue(), memory.str() ));
+        addProperty(SystemModule::HARDWARE_VIRTUAL_MEMORY, theFactory->createInteger(sys_info.totalswap));
+        addProperty(SystemModule::HARDWARE_PHYSICAL_MEMORY, theFactory->createInteger(sys_info.totalram));
       }
+      addMemoryConfig();
 # elif defined __APPLE__
       int mib[2];
       size_t len = 8;
@@ -545,27 +482,109 @@ namespace zorba { namespace system {
       mib[0] = CTL_HW;
       mib[1] = HW_MEMSIZE;
       sysctl(mib, 2, &res, &len, NULL, NULL);
-      std::stringstream lStream;
-      lStream << res;
-      theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::HARDWARE_PHYSICAL_MEMORY).getStringValue(), lStream.str()));
+      addProperty(SystemModule::HARDWARE_PHYSICAL_MEMORY, theFactory->createInteger(res));
 # endif
+      long lPageSize = sysconf(_SC_PAGESIZE);
+      if (lPageSize > 0)
+        addProperty(SystemModule::HARDWARE_MEMORY_PAGE_SIZE, theFactory->createInteger(lPageSize));
     }
 
 #endif
 #ifdef LINUX
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::LINUX_DISTRIBUTOR).getStringValue(), ""));
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::LINUX_DISTRIBUTOR_VERSION).getStringValue(), ""));
+    {
+      // lsb_release is run once, when the module is loaded
+      ProcReader lReader;
+      std::pair<std::string, std::string> lDistribution = getDistribution(lReader);
+      addProperty(SystemModule::LINUX_DISTRIBUTOR, lDistribution.first);
+      addProperty(SystemModule::LINUX_DISTRIBUTOR_VERSION, lDistribution.second);
+    }
 #endif
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::ZORBA_VER).getStringValue(), Zorba::version().getVersion()));
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::ZORBA_VER_MAJOR).getStringValue(), intToString(Zorba::version().getMajorVersion())));
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::ZORBA_VER_MINOR).getStringValue(), intToString(Zorba::version().getMinorVersion())));
-    theProperties.insert(std::make_pair(SystemModule::getGlobalKey(SystemModule::ZORBA_VER_PATCH).getStringValue(), intToString(Zorba::version().getPatchVersion())));
+    addProperty(SystemModule::ZORBA_MODULE_PATH, Property::MODULE_PATH);
+    addProperty(SystemModule::ZORBA_VER, Zorba::version().getVersion());
+    addProperty(SystemModule::ZORBA_VER_MAJOR, theFactory->createInteger(Zorba::version().getMajorVersion()));
+    addProperty(SystemModule::ZORBA_VER_MINOR, theFactory->createInteger(Zorba::version().getMinorVersion()));
+    addProperty(SystemModule::ZORBA_VER_PATCH, theFactory->createInteger(Zorba::version().getPatchVersion()));
   }
 
-  String SystemFunction::intToString(int v) {
-    std::stringstream ss;
-    ss << v;
-    return ss.str();
+  void SystemModule::addProperty(SystemModule::GLOBAL_KEY aKey, const Item& aValue)
+  {
+    addProperty(getGlobalKey(aKey), aValue);
+  }
+
+  void SystemModule::addProperty(SystemModule::GLOBAL_KEY aKey, const String& aValue)
+  {
+    Item lValue = theFactory->createString(aValue);
+    addProperty(getGlobalKey(aKey), lValue, lValue);
+  }
+
+  void SystemModule::addProperty(const Item& aKey, const Item& aValue)
+  {
+    addProperty(aKey, aValue, theFactory->createString(aValue.getStringValue()));
+  }
+
+  void SystemModule::addProperty(const Item& aKey, const Item& aValue, const Item& aStringValue)
+  {
+    Property lProperty;
+    lProperty.theSource = Property::STATIC;
+    lProperty.theKey = aKey;
+    lProperty.theValue = aValue;
+    lProperty.theStringValue = aStringValue;
+    theProperties.insert(std::make_pair(aKey.getStringValue(), lProperty));
+  }
+
+  void SystemModule::addProperty(SystemModule::GLOBAL_KEY aKey, Property::SOURCE aSource)
+  {
+    Property lProperty;
+    lProperty.theSource = aSource;
+    lProperty.theKey = getGlobalKey(aKey);
+    theProperties.insert(std::make_pair(lProperty.theKey.getStringValue(), lProperty));
+  }
+
+#ifdef LINUX
+  void SystemModule::addMemoryConfig()
+  {
+    ProcReader lReader;
+    long lValue;
+    std::string lMode;
+
+    // hugepage pools, one directory per page size (e.g. hugepages-2048kB)
+    const std::string lHugepages = "/sys/kernel/mm/hugepages/";
+    DIR* lDir = opendir(lHugepages.c_str());
+    if (lDir) {
+      struct dirent* lEntry;
+      while ((lEntry = readdir(lDir)) != NULL) {
+        StringRef lName(lEntry->d_name, strlen(lEntry->d_name));
+        if (!lName.startsWith("hugepages-"))
+          continue;
+        std::string lPool = lHugepages + lName.str();
+        std::string lKey = "hardware.memory.hugepages." + lName.substr(10).str();
+        if (readLong(lReader, (lPool + "/nr_hugepages").c_str(), lValue))
+          addProperty(theFactory->createString(lKey + ".total"), theFactory->createInteger(lValue));
+        if (readLong(lReader, (lPool + "/free_hugepages").c_str(), lValue))
+          addProperty(theFactory->createString(lKey + ".free"), theFactory->createInteger(lValue));
+      }
+      closedir(lDir);
+    }
+
+    if (readSelection(lReader, "/sys/kernel/mm/transparent_hugepage/enabled", lMode))
+      addProperty(SystemModule::HARDWARE_MEMORY_THP, lMode);
+    if (readSelection(lReader, "/sys/kernel/mm/transparent_hugepage/defrag", lMode))
+      addProperty(SystemModule::HARDWARE_MEMORY_THP_DEFRAG, lMode);
+    if (readLong(lReader, "/proc/sys/vm/overcommit_memory", lValue))
+      addProperty(SystemModule::HARDWARE_MEMORY_OVERCOMMIT, theFactory->createInteger(lValue));
+    if (readLong(lReader, "/proc/sys/vm/overcommit_ratio", lValue))
+      addProperty(SystemModule::HARDWARE_MEMORY_OVERCOMMIT_RATIO, theFactory->createInteger(lValue));
+    if (readLong(lReader, "/proc/sys/vm/swappiness", lValue))
+      addProperty(SystemModule::HARDWARE_MEMORY_SWAPPINESS, theFactory->createInteger(lValue));
+    if (readLong(lReader, "/proc/sys/kernel/numa_balancing", lValue))
+      addProperty(SystemModule::HARDWARE_MEMORY_NUMA_BALANCING, theFactory->createInteger(lValue));
+  }
+#endif
+
+  SystemFunction::SystemFunction(const SystemModule* aModule)
+    : theModule(aModule), theFactory(aModule->getItemFactory()),
+      theProperties(aModule->getProperties())
+  {
   }
 
   bool SystemFunction::getEnv(const String& name, String& value) const
@@ -625,20 +644,116 @@ namespace zorba { namespace system {
 #endif
   }
 
+  const String ModulePathCache::NAME = "http://zorba.io/modules/system:module-path-cache";
+
+  Item SystemFunction::getModulePath(const StaticContext* aSctx, const DynamicContext* aDctx) const
+  {
+    ModulePathCache* lCache = static_cast<ModulePathCache*>(
+        aDctx->getExternalFunctionParameter(ModulePathCache::NAME));
+    if (lCache)
+      return lCache->theValue;
+
+    std::vector<String> lModulePaths;
+    aSctx->getFullModulePaths(lModulePaths);
+    Item lItem = joinModulePaths(lModulePaths);
+    lCache = new ModulePathCache(lItem);
+    if (!aDctx->addExternalFunctionParameter(ModulePathCache::NAME, lCache))
+      lCache->destroy();
+    return lItem;
+  }
+
+  Item SystemFunction::joinModulePaths(const std::vector<String>& aPaths) const
+  {
+    std::string::size_type lSize = 0;
+    for (std::vector<String>::const_iterator i = aPaths.begin(); i != aPaths.end(); ++i)
+      lSize += i->size() + 1;
+    std::string lRes;
+    lRes.reserve(lSize);
+    for (std::vector<String>::const_iterator i = aPaths.begin(); i != aPaths.end(); ++i) {
+      if (i != aPaths.begin()) {
+#ifdef WIN32
+        lRes += ';';
+#else
+        lRes += ':';
+#endif
+      }
+      lRes.append(i->c_str(), i->size());
+    }
+    return theFactory->createString(lRes);
+  }
+
+  Item SystemFunction::getProperty(const String& aKey, bool aTyped,
+                                   const StaticContext* aSctx, const DynamicContext* aDctx) const
+  {
+    std::map<String, Property>::const_iterator i = theProperties.find(aKey);
+    if (i != theProperties.end()) {
+      switch (i->second.theSource) {
+      case Property::STATIC:
+        return aTyped ? i->second.theValue : i->second.theStringValue;
+      case Property::MODULE_PATH:
+        return getModulePath(aSctx, aDctx);
+      default:
+        return Item();
+      }
+    } else if (strncmp(aKey.c_str(), "env.", 4) == 0) {
+      String lRes;
+      if (!getEnv(aKey.substr(4), lRes)) {
+        return Item();
+      }
+      return theFactory->createString(lRes);
+    }
+    return Item();
+  }
+
   ItemSequence_t PropertiesFunction::evaluate(
       const ExternalFunction::Arguments_t& args) const {
     std::vector<Item> lRes;
     getEnvNames(lRes);
-    for (std::map<String, String>::const_iterator i = theProperties.begin();
+    lRes.reserve(lRes.size() + theProperties.size());
+    for (std::map<String, Property>::const_iterator i = theProperties.begin();
         i != theProperties.end(); ++i) {
-      Item lItem = theFactory->createString(i->first.c_str());
-      lRes.push_back(lItem);
+      lRes.push_back(i->second.theKey);
     }
-    // insert the zorba module path
-    lRes.push_back(SystemModule::getGlobalKey(SystemModule::ZORBA_MODULE_PATH));
     return ItemSequence_t(new VectorItemSequence(lRes));
   }
 
+  ItemSequence_t LimitsFunction::evaluate(
+      const ExternalFunction::Arguments_t& args) const {
+    std::vector<std::pair<Item, Item> > lLimits;
+#ifndef WIN32
+    static const struct { const char* theName; int theResource; } lResources[] = {
+      { "nofile", RLIMIT_NOFILE },
+      { "as", RLIMIT_AS },
+      { "data", RLIMIT_DATA },
+      { "stack", RLIMIT_STACK },
+      { "nproc", RLIMIT_NPROC },
+      { "memlock", RLIMIT_MEMLOCK }
+    };
+    for (size_t i = 0; i < sizeof(lResources) / sizeof(lResources[0]); ++i) {
+      struct rlimit lLimit;
+      if (getrlimit(lResources[i].theResource, &lLimit) != 0)
+        continue;
+      std::vector<std::pair<Item, Item> > lPair;
+      // unlimited resources are reported as null
+      lPair.push_back(std::make_pair(theFactory->createString("soft"),
+        lLimit.rlim_cur == RLIM_INFINITY ? theFactory->createJSONNull()
+                                         : theFactory->createInteger(lLimit.rlim_cur)));
+      lPair.push_back(std::make_pair(theFactory->createString("hard"),
+        lLimit.rlim_max == RLIM_INFINITY ? theFactory->createJSONNull()
+                                         : theFactory->createInteger(lLimit.rlim_max)));
+      lLimits.push_back(std::make_pair(theFactory->createString(lResources[i].theName),
+                                       theFactory->createJSONObject(lPair)));
+    }
+#endif
+#ifdef LINUX
+    long lOpenFiles = countOpenFiles();
+    if (lOpenFiles >= 0)
+      lLimits.push_back(std::make_pair(theFactory->createString("open.files"),
+                                       theFactory->createInteger(lOpenFiles)));
+#endif
+    return ItemSequence_t(new SingletonItemSequence(theFactory->createJSONObject(lLimits)));
+  }
+
   ItemSequence_t PropertyFunction::evaluate(
       const ExternalFunction::Arguments_t& args,
       const StaticContext* sctx,
@@ -648,42 +763,31 @@ namespace zorba { namespace system {
     arg0_iter->open();
     arg0_iter->next(item);
     arg0_iter->close();
-    String envS = item.getStringValue();
-    String lRes;
-    if (envS == SystemModule::getGlobalKey(SystemModule::ZORBA_MODULE_PATH).getStringValue().str()) {
-      std::vector<String> lModulePaths;
-      sctx->getFullModulePaths(lModulePaths);
-      if (lModulePaths.size() == 0)
-        return ItemSequence_t(new SingletonItemSequence(theFactory->createString("")));
-      lRes = lModulePaths[0];
-      for (std::vector<String>::iterator i = lModulePaths.begin() + 1; i != lModulePaths.end(); ++i) {
-#ifdef WIN32
-        lRes += ";";
-#else
-        lRes += ":";
-#endif
-        lRes += *i;
-      }
-    } else if (envS.substr(0,4) == "env.") {
-      //Sleep(5000);
-      if (!getEnv(envS.substr(4), lRes)) {
-        return ItemSequence_t(new EmptySequence());
-      }
-#ifdef LINUX
-    } else if (envS == SystemModule::getGlobalKey(SystemModule::LINUX_DISTRIBUTOR).getStringValue().str()) {
-      lRes = getDistribution().first;
-    } else if (envS == SystemModule::getGlobalKey(SystemModule::LINUX_DISTRIBUTOR_VERSION).getStringValue().str()) {
-      lRes = getDistribution().second;
-#endif
-    } else {
-      std::map<String, String>::const_iterator i;
-      if ((i = theProperties.find(envS.c_str())) != theProperties.end()) {
-        lRes = i->second;
-      } else {
-        return ItemSequence_t(new EmptySequence());
-      }
+    Item lRes = getProperty(item.getStringValue(), false, sctx, dctx);
+    if (lRes.isNull()) {
+      return ItemSequence_t(new EmptySequence());
     }
-    return ItemSequence_t(new SingletonItemSequence(theFactory->createString(lRes)));
+    return ItemSequence_t(new SingletonItemSequence(lRes));
+  }
+
+  ItemSequence_t TypedPropertyFunction::evaluate(
+      const ExternalFunction::Arguments_t& args,
+      const StaticContext* sctx,
+      const DynamicContext* dctx) const {
+    Item item;
+    Iterator_t arg0_iter = args[0]->getIterator();
+    arg0_iter->open();
+    arg0_iter->next(item);
+    arg0_iter->close();
+    Item lRes = getProperty(item.getStringValue(), true, sctx, dctx);
+    if (lRes.isNull()) {
+      return ItemSequence_t(new EmptySequence());
+    }
+    return ItemSequence_t(new SingletonItemSequence(lRes));
   }
 }} // namespace zorba, system
 
+
+extern "C" DLL_EXPORT zorba::ExternalModule* createModule() {
+  return new zorba::system::SystemModule();
+}
@@ -22,47 +22,59 @@
 #include <zorba/zorba.h>
 #include <zorba/external_module.h>
 #include <zorba/function.h>
+#include <zorba/external_function_parameter.h>
 
 namespace zorba { namespace system {
+  // A property with its key and values created upfront, such that lookups
+  // can hand out the Items without creating new ones. Properties which are
+  // computed on request, e.g. zorba.module.path, only carry their key.
+  struct Property {
+    enum SOURCE { STATIC, MODULE_PATH };
+
+    SOURCE theSource;
+    Item theKey;
+    Item theValue;        // typed value
+    Item theStringValue;  // xs:string value
+  };
+
   class SystemModule : public ExternalModule {
-    protected:
-      static zorba::Item globalOSName;
-      static zorba::Item globalOSNodeName;
-      static zorba::Item globalOSVersionMajor;
-      static zorba::Item globalOSVersionMinor;
-      static zorba::Item globalOSVersionBuild;
-      static zorba::Item globalOSVersionRelease;
-      static zorba::Item globalOSVersionVersion;
-      static zorba::Item globalOSVersion;
-      static zorba::Item globalOSArch;
-      static zorba::Item globalOSis64;
-      static zorba::Item globalHWLogicalCPU;
-      static zorba::Item globalHWPhysicalCPU;
-      static zorba::Item globalHWLogicalPerPhysicalCPU;
-      static zorba::Item globalHWPhysicalMemory;
-      static zorba::Item globalHWVirtualMemory;
-      static zorba::Item globalHWManufacturer;
-      static zorba::Item globalLinuxDistributor;
-      static zorba::Item globalLinuxDistributorVersion;
-      static zorba::Item globalUserName;
-      static zorba::Item globalZorbaModulePath;
-      static zorba::Item globalZorbaVersion;
-      static zorba::Item globalZorbaVersionMajor;
-      static zorba::Item globalZorbaVersionMinor;
-      static zorba::Item globalZorbaVersionPatch;
-    private:
-      ExternalFunction* thePropertyFunction;
-      ExternalFunction* thePropertiesFunction;
-      const static String SYSTEM_MODULE_NAMESPACE;
     public:
       enum GLOBAL_KEY { OS_NAME, OS_NODE_NAME, OS_VER_MAJOR, OS_VER_MINOR,
                         OS_VER_BUILD, OS_VER_RELEASE, OS_VER_VERSION, OS_VER,
                         OS_ARCH, OS_IS64, HARDWARE_lOGICAL_CPU, HARDWARE_PHYSICAL_CPU,
                         HARDWARE_LOGICAL_PER_PHYSICAL_CPU, HARDWARE_PHYSICAL_MEMORY,
-                        HARDWARE_VIRTUAL_MEMORY, HARDWARE_MANUFACTURER, LINUX_DISTRIBUTOR,
+                        HARDWARE_VIRTUAL_MEMORY, HARDWARE_MANUFACTURER,
+                        HARDWARE_MEMORY_PAGE_SIZE, HARDWARE_MEMORY_THP, HARDWARE_MEMORY_THP_DEFRAG,
+                        HARDWARE_MEMORY_OVERCOMMIT, HARDWARE_MEMORY_OVERCOMMIT_RATIO,
+                        HARDWARE_MEMORY_SWAPPINESS, HARDWARE_MEMORY_NUMA_BALANCING, LINUX_DISTRIBUTOR,
                         LINUX_DISTRIBUTOR_VERSION, USER_NAME, ZORBA_MODULE_PATH, ZORBA_VER, ZORBA_VER_MAJOR,
-                        ZORBA_VER_MINOR, ZORBA_VER_PATCH };
-                        
+                        ZORBA_VER_MINOR, ZORBA_VER_PATCH, GLOBAL_KEY_COUNT };
+    private:
+      ItemFactory* theFactory;
+      // the keys belong to the module instance, such that they are recreated
+      // together with the store when Zorba is shut down and started again
+      Item theGlobalKeys[GLOBAL_KEY_COUNT];
+      // probed once when the module is created and read-only afterwards
+      std::map<String, Property> theProperties;
+      ExternalFunction* thePropertyFunction;
+      ExternalFunction* thePropertiesFunction;
+      ExternalFunction* theTypedPropertyFunction;
+      ExternalFunction* theLimitsFunction;
+      const static String SYSTEM_MODULE_NAMESPACE;
+
+      void initProperties();
+      void addProperty(const Item& aKey, const Item& aValue, const Item& aStringValue);
+      // typed values get a separate xs:string Item
+      void addProperty(GLOBAL_KEY aKey, const Item& aValue);
+      void addProperty(const Item& aKey, const Item& aValue);
+      // xs:string values are stored once, as both the typed and string value
+      void addProperty(GLOBAL_KEY aKey, const String& aValue);
+      void addProperty(GLOBAL_KEY aKey, Property::SOURCE aSource);
+#ifdef LINUX
+      // page sizes, hugepages, overcommit, swappiness and NUMA balancing
+      void addMemoryConfig();
+#endif
+    public:
       SystemModule();
       virtual ~SystemModule();
       
@@ -71,27 +83,50 @@ namespace zorba { namespace system {
       virtual ExternalFunction* getExternalFunction(const String& localName);
 
       virtual void destroy();
-      
-      static zorba::Item& getGlobalKey(enum GLOBAL_KEY g);
+
+      const Item& getGlobalKey(GLOBAL_KEY g) const { return theGlobalKeys[g]; }
+      ItemFactory* getItemFactory() const { return theFactory; }
+      const std::map<String, Property>& getProperties() const { return theProperties; }
+  };
+
+  // The joined zorba.module.path Item of a query, registered in its
+  // DynamicContext. The module paths of a query are fixed when it is
+  // compiled, and every query has its own DynamicContext, so the Item is
+  // valid for as long as the context; a query compiled with other paths
+  // has its own cache.
+  class ModulePathCache : public ExternalFunctionParameter {
+    public:
+      static const String NAME;
+      const Item theValue;
+
+      ModulePathCache(const Item& aValue) : theValue(aValue) {}
+
+      virtual void destroy() throw() { delete this; }
   };
 
   class SystemFunction {
     protected:
-      const ExternalModule* theModule;
+      const SystemModule* theModule;
       ItemFactory* theFactory;
-      std::map<String, String> theProperties;
+      const std::map<String, Property>& theProperties;
     public:
-      SystemFunction(const ExternalModule* aModule);
+      SystemFunction(const SystemModule* aModule);
+
+      // returns the value of the property or a null Item if the key is unknown;
+      // the value is always an xs:string unless aTyped is set
+      Item getProperty(const String& aKey, bool aTyped,
+                       const StaticContext* aSctx, const DynamicContext* aDctx) const;
     protected:
       String getURI() const { return theModule->getURI(); }
       bool getEnv(const String& name, String& value) const;
       void getEnvNames(std::vector<Item>& names) const;
-      String intToString(int v);
+      Item getModulePath(const StaticContext* aSctx, const DynamicContext* aDctx) const;
+      Item joinModulePaths(const std::vector<String>& aPaths) const;
   };
 
   class PropertiesFunction : public NonContextualExternalFunction, public SystemFunction {
     public:
-      PropertiesFunction(const ExternalModule* mod) : SystemFunction(mod) {}
+      PropertiesFunction(const SystemModule* mod) : SystemFunction(mod) {}
 
       virtual String getLocalName() const { return "properties"; }
 
@@ -100,9 +135,25 @@ namespace zorba { namespace system {
       virtual String getURI() const { return SystemFunction::getURI(); }
   };
 
+  // system:limits() reads live values only and needs no property table
+  class LimitsFunction : public NonContextualExternalFunction {
+    private:
+      const SystemModule* theModule;
+      ItemFactory* theFactory;
+    public:
+      LimitsFunction(const SystemModule* mod)
+        : theModule(mod), theFactory(mod->getItemFactory()) {}
+
+      virtual String getLocalName() const { return "limits"; }
+
+      virtual ItemSequence_t 
+      evaluate(const ExternalFunction::Arguments_t& args) const;
+      virtual String getURI() const { return theModule->getURI(); }
+  };
+
   class PropertyFunction : public ContextualExternalFunction, public SystemFunction {
     public:
-      PropertyFunction(const ExternalModule* mod) : SystemFunction(mod) {}
+      PropertyFunction(const SystemModule* mod) : SystemFunction(mod) {}
 
       virtual String getLocalName() const { return "property"; }
 
@@ -113,6 +164,19 @@ namespace zorba { namespace system {
       virtual String getURI() const { return SystemFunction::getURI(); }
   };
 
+  class TypedPropertyFunction : public ContextualExternalFunction, public SystemFunction {
+    public:
+      TypedPropertyFunction(const SystemModule* mod) : SystemFunction(mod) {}
+
+      virtual String getLocalName() const { return "typed-property"; }
+
+      virtual ItemSequence_t 
+      evaluate(const ExternalFunction::Arguments_t& args,
+               const StaticContext* sctx,
+               const DynamicContext* dctx) const;
+      virtual String getURI() const { return SystemFunction::getURI(); }
+  };
+
 } } // namespace zorba, namespace system
 
 #ifdef WIN32
@@ -121,8 +185,6 @@ namespace zorba { namespace system {
 #  define DLL_EXPORT __attribute__ ((visibility("default")))
 #endif
 
-extern "C" DLL_EXPORT zorba::ExternalModule* createModule() {
-  return new zorba::system::SystemModule();
-}
+extern "C" DLL_EXPORT zorba::ExternalModule* createModule();
 
 #endif // __COM_ZORBA_WWW_MODULES_SYSTEM_H__
@@ -0,0 +1 @@
+true true true true true true true true
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replaces the global operator new with one that counts its calls between
+// startCounting() and stopCounting(). Include it in exactly one translation
+// unit of a test executable.
+#ifndef __COM_ZORBA_WWW_MODULES_SYSTEM_ALLOCATION_COUNTER_H__
+#define __COM_ZORBA_WWW_MODULES_SYSTEM_ALLOCATION_COUNTER_H__
+#include <cstdlib>
+#include <new>
+
+#if __cplusplus >= 201103L
+# define THROW_BAD_ALLOC
+#else
+# define THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+static bool theCounting = false;
+static long theAllocations = 0;
+
+void* operator new(std::size_t aSize) THROW_BAD_ALLOC
+{
+  if (theCounting)
+    ++theAllocations;
+  void* lPtr = std::malloc(aSize ? aSize : 1);
+  if (!lPtr)
+    throw std::bad_alloc();
+  return lPtr;
+}
+
+void* operator new[](std::size_t aSize) THROW_BAD_ALLOC
+{
+  return operator new(aSize);
+}
+
+void operator delete(void* aPtr) throw()
+{
+  std::free(aPtr);
+}
+
+void operator delete[](void* aPtr) throw()
+{
+  std::free(aPtr);
+}
+
+static void startCounting()
+{
+  theAllocations = 0;
+  theCounting = true;
+}
+
+// returns the number of allocations since startCounting()
+static long stopCounting()
+{
+  theCounting = false;
+  return theAllocations;
+}
+
+#endif // __COM_ZORBA_WWW_MODULES_SYSTEM_ALLOCATION_COUNTER_H__
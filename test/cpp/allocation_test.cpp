@@ -0,0 +1,128 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Counts the allocations of system:property and system:typed-property, as
+// evaluated by a query, for properties with a static value. Such a lookup
+// must hand out the Items created when the module was loaded: besides
+// reading the argument, which is up to Zorba, the only allocation left is
+// the result sequence.
+#include <cstdio>
+
+#include <zorba/zorba.h>
+#include <zorba/store_manager.h>
+#include <zorba/singleton_item_sequence.h>
+#include <zorba/empty_sequence.h>
+
+#include "allocation_counter.h"
+#include "system.h"
+
+using namespace zorba;
+using namespace zorba::system;
+
+static int theFailures = 0;
+
+// what evaluate() has to spend on reading its argument
+static long argumentAllocations(ItemSequence* aArg)
+{
+  startCounting();
+  {
+    Item lItem;
+    Iterator_t lIter = aArg->getIterator();
+    lIter->open();
+    lIter->next(lItem);
+    lIter->close();
+    String lKey = lItem.getStringValue();
+  }
+  return stopCounting();
+}
+
+// what evaluate() has to spend on the result sequence
+static long resultAllocations(bool aKnown)
+{
+  ItemFactory* lFactory = Zorba::getInstance(0)->getItemFactory();
+  Item lValue = lFactory->createString("value");
+  startCounting();
+  {
+    ItemSequence_t lSeq(aKnown ? static_cast<ItemSequence*>(new SingletonItemSequence(lValue))
+                               : static_cast<ItemSequence*>(new EmptySequence()));
+  }
+  return stopCounting();
+}
+
+static void checkEvaluate(const ContextualExternalFunction* aFunction,
+                          const XQuery_t& aQuery, const char* aKey, bool aKnown)
+{
+  const int ITERATIONS = 1000;
+  ItemFactory* lFactory = Zorba::getInstance(0)->getItemFactory();
+  ItemSequence_t lArg(new SingletonItemSequence(lFactory->createString(aKey)));
+  ExternalFunction::Arguments_t lArgs(1, lArg.get());
+  const StaticContext* lSctx = aQuery->getStaticContext();
+  const DynamicContext* lDctx = aQuery->getDynamicContext();
+
+  // the first call may fill lazily initialized state outside the module
+  Item lItem;
+  ItemSequence_t lRes = aFunction->evaluate(lArgs, lSctx, lDctx);
+  Iterator_t lIter = lRes->getIterator();
+  lIter->open();
+  bool lKnown = lIter->next(lItem);
+  lIter->close();
+
+  long lExpected = ITERATIONS * (argumentAllocations(lArg.get()) + resultAllocations(aKnown));
+  startCounting();
+  for (int i = 0; i < ITERATIONS; ++i)
+    aFunction->evaluate(lArgs, lSctx, lDctx);
+  long lAllocations = stopCounting();
+
+  std::printf("%-16s %-28s %ld allocation(s) in %d calls, expected %ld\n",
+              aFunction->getLocalName().c_str(), aKey, lAllocations, ITERATIONS, lExpected);
+  if (lAllocations != lExpected || lKnown != aKnown) {
+    std::fprintf(stderr, "%s: expected %ld allocations and a %s result\n",
+                 aKey, lExpected, aKnown ? "non-empty" : "empty");
+    ++theFailures;
+  }
+}
+
+int main()
+{
+  void* lStore = StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+  {
+    // the contexts a query hands to the functions
+    XQuery_t lQuery = lZorba->compileQuery("1", lZorba->createStaticContext());
+
+    ExternalModule* lModule = createModule();
+    const ContextualExternalFunction* lFunctions[] = {
+      static_cast<ContextualExternalFunction*>(lModule->getExternalFunction("property")),
+      static_cast<ContextualExternalFunction*>(lModule->getExternalFunction("typed-property"))
+    };
+    const char* const lKeys[] = { "os.name", "os.is64", "zorba.version",
+                                  "zorba.version.major", "hardware.memory.page.size" };
+    for (size_t f = 0; f < 2; ++f) {
+      for (size_t i = 0; i < sizeof(lKeys) / sizeof(lKeys[0]); ++i)
+        checkEvaluate(lFunctions[f], lQuery, lKeys[i], true);
+      checkEvaluate(lFunctions[f], lQuery, "no.such.property", false);
+    }
+    lModule->destroy();
+  }
+  lZorba->shutdown();
+  StoreManager::shutdownStore(lStore);
+
+  if (theFailures) {
+    std::fprintf(stderr, "%d check(s) failed\n", theFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Evaluates system:property, system:properties() and system:all-properties()
+// from 1 to N threads at the same time and reports the throughput scaling
+// of each.
+//
+//   concurrency_bench [max threads] [iterations per thread]
+//
+// Every query is compiled once and every thread runs its own clone, so all
+// threads share one instance of the system module, as in a server. All
+// properties looked up here, linux.distributor* included, are probed when
+// the module is loaded, so the queries measure the lookups of the module
+// rather than the probes. Exits with 1 if a thread fails or sees a
+// different result than the first run. Configure with
+// -DZORBA_SYSTEM_WITH_TSAN=ON, against a Zorba built with
+// -fsanitize=thread as well, to run it under ThreadSanitizer.
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <zorba/zorba.h>
+#include <zorba/store_manager.h>
+#include <zorba/zorba_exception.h>
+
+using namespace zorba;
+
+static const char* const PROLOG =
+  "import module namespace system = \"http://zorba.io/modules/system\";\n"
+  "declare namespace jn = \"http://jsoniq.org/functions\";\n";
+
+static const struct { const char* theName; const char* theBody; } QUERIES[] = {
+  { "property",
+    "(system:property(\"os.name\"), system:property(\"zorba.version\"),\n"
+    " system:property(\"zorba.module.path\") instance of xs:string)" },
+  { "properties",
+    "count(system:properties()) gt 0" },
+  { "all-properties",
+    "count(jn:keys(system:all-properties())) gt 0" }
+};
+
+struct Worker {
+  XQuery_t theQuery;
+  std::string theExpected;
+  int theIterations;
+  bool theFailed;
+};
+
+static std::string run(const XQuery_t& aQuery)
+{
+  std::ostringstream lOut;
+  Zorba_SerializerOptions lOptions;
+  lOptions.omit_xml_declaration = ZORBA_OMIT_XML_DECLARATION_YES;
+  aQuery->execute(lOut, &lOptions);
+  return lOut.str();
+}
+
+static void* work(void* aWorker)
+{
+  Worker* lWorker = static_cast<Worker*>(aWorker);
+  try {
+    for (int i = 0; i < lWorker->theIterations; ++i) {
+      if (run(lWorker->theQuery) != lWorker->theExpected) {
+        std::cerr << "unexpected result in iteration " << i << std::endl;
+        lWorker->theFailed = true;
+        return 0;
+      }
+    }
+  } catch (ZorbaException const& e) {
+    std::cerr << e << std::endl;
+    lWorker->theFailed = true;
+  }
+  return 0;
+}
+
+static double now()
+{
+  struct timeval lTime;
+  gettimeofday(&lTime, 0);
+  return lTime.tv_sec + lTime.tv_usec / 1e6;
+}
+
+static bool bench(Zorba* aZorba, const char* aName, const char* aBody,
+                  int aMaxThreads, int aIterations)
+{
+  StaticContext_t lSctx = aZorba->createStaticContext();
+  std::vector<String> lURIPath(1, SYSTEM_URI_PATH);
+  std::vector<String> lLibPath(1, SYSTEM_LIB_PATH);
+  lSctx->setURIPath(lURIPath);
+  lSctx->setLibPath(lLibPath);
+  XQuery_t lQuery = aZorba->compileQuery((std::string(PROLOG) + aBody).c_str(), lSctx);
+  std::string lExpected = run(lQuery);
+  std::printf("%s: %s\n", aName, lExpected.c_str());
+
+  double lSingle = 0;
+  bool lOk = true;
+  for (int lThreads = 1; lThreads <= aMaxThreads && lOk; ++lThreads) {
+    std::vector<Worker> lWorkers(lThreads);
+    std::vector<pthread_t> lIds(lThreads);
+    for (int i = 0; i < lThreads; ++i) {
+      lWorkers[i].theQuery = lQuery->clone();
+      lWorkers[i].theExpected = lExpected;
+      lWorkers[i].theIterations = aIterations;
+      lWorkers[i].theFailed = false;
+    }
+
+    double lStart = now();
+    for (int i = 0; i < lThreads; ++i)
+      pthread_create(&lIds[i], 0, work, &lWorkers[i]);
+    for (int i = 0; i < lThreads; ++i)
+      pthread_join(lIds[i], 0);
+    double lTime = now() - lStart;
+
+    for (int i = 0; i < lThreads; ++i)
+      lOk = lOk && !lWorkers[i].theFailed;
+
+    double lThroughput = lThreads * aIterations / lTime;
+    if (lThreads == 1)
+      lSingle = lThroughput;
+    std::printf("  %3d thread(s)  %10.0f queries/s  scaling %5.2fx\n",
+                lThreads, lThroughput, lThroughput / lSingle);
+  }
+  return lOk;
+}
+
+int main(int argc, char** argv)
+{
+  int lMaxThreads = argc > 1 ? atoi(argv[1]) : 8;
+  int lIterations = argc > 2 ? atoi(argv[2]) : 1000;
+  if (lMaxThreads <= 0)
+    lMaxThreads = 1;
+  if (lIterations <= 0)
+    lIterations = 1;
+
+  void* lStore = StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+  bool lOk = false;
+  try {
+    lOk = true;
+    for (size_t i = 0; i < sizeof(QUERIES) / sizeof(QUERIES[0]); ++i) {
+      lOk = bench(lZorba, QUERIES[i].theName, QUERIES[i].theBody,
+                  lMaxThreads, lIterations) && lOk;
+    }
+  } catch (ZorbaException const& e) {
+    std::cerr << e << std::endl;
+    lOk = false;
+  }
+  lZorba->shutdown();
+  StoreManager::shutdownStore(lStore);
+  return lOk ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that zorba.module.path is joined once per query: further lookups
+// in the same query return the cached Item without allocating, and a query
+// compiled with other module paths doesn't see the Item of another query.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <zorba/zorba.h>
+#include <zorba/store_manager.h>
+
+#include "allocation_counter.h"
+#include "system.h"
+
+using namespace zorba;
+using namespace zorba::system;
+
+static int theFailures = 0;
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n",              \
+                   __FILE__, __LINE__, #cond);                       \
+      ++theFailures;                                                 \
+    }                                                                \
+  } while (0)
+
+static XQuery_t compile(Zorba* aZorba, const char* aModulePath)
+{
+  StaticContext_t lSctx = aZorba->createStaticContext();
+  std::vector<String> lPaths(1, aModulePath);
+  lSctx->setModulePaths(lPaths);
+  return aZorba->compileQuery("1", lSctx);
+}
+
+static std::string lookup(const SystemFunction* aFunction, const XQuery_t& aQuery)
+{
+  Item lRes = aFunction->getProperty("zorba.module.path", false,
+                                     aQuery->getStaticContext(),
+                                     aQuery->getDynamicContext());
+  return lRes.isNull() ? std::string() : lRes.getStringValue().str();
+}
+
+static void testModulePath(Zorba* aZorba, const SystemFunction* aFunction)
+{
+  const String lKey("zorba.module.path");
+  XQuery_t lQueryA = compile(aZorba, "/tmp/system-module-test/a/");
+  XQuery_t lQueryB = compile(aZorba, "/tmp/system-module-test/b/");
+  const StaticContext* lSctx = lQueryA->getStaticContext();
+  const DynamicContext* lDctx = lQueryA->getDynamicContext();
+
+  std::string lPathA = lookup(aFunction, lQueryA);
+  CHECK(lPathA.find("/tmp/system-module-test/a/") != std::string::npos);
+  CHECK(lPathA.find("/tmp/system-module-test/b/") == std::string::npos);
+
+  // what a cache hit may cost at most: finding the cache in the context
+  startCounting();
+  lDctx->getExternalFunctionParameter(ModulePathCache::NAME);
+  long lLookupAllocations = stopCounting();
+
+  // the second lookup in the query hands out the cached Item: the paths are
+  // neither fetched nor joined, and no string Item is created
+  startCounting();
+  Item lSecond = aFunction->getProperty(lKey, false, lSctx, lDctx);
+  long lHitAllocations = stopCounting();
+  std::printf("zorba.module.path cache hit: %ld allocation(s), context lookup: %ld\n",
+              lHitAllocations, lLookupAllocations);
+  CHECK(lHitAllocations == lLookupAllocations);
+  CHECK(!lSecond.isNull() && lSecond.getStringValue().str() == lPathA);
+
+  // other module paths, other query: a cache miss with the new paths
+  std::string lPathB = lookup(aFunction, lQueryB);
+  CHECK(lPathB.find("/tmp/system-module-test/b/") != std::string::npos);
+  CHECK(lPathB.find("/tmp/system-module-test/a/") == std::string::npos);
+
+  // and the cache of the first query is untouched
+  CHECK(lookup(aFunction, lQueryA) == lPathA);
+}
+
+int main()
+{
+  void* lStore = StoreManager::getStore();
+  Zorba* lZorba = Zorba::getInstance(lStore);
+
+  ExternalModule* lModule = createModule();
+  testModulePath(lZorba,
+      static_cast<PropertyFunction*>(lModule->getExternalFunction("property")));
+  lModule->destroy();
+
+  lZorba->shutdown();
+  StoreManager::shutdownStore(lStore);
+
+  if (theFailures) {
+    std::fprintf(stderr, "%d check(s) failed\n", theFailures);
+    return 1;
+  }
+  return 0;
+}
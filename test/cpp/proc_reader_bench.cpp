@@ -0,0 +1,223 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the ProcReader based cpuinfo parser of the system module with
+// the std::ifstream/getline/trim parser it replaced.
+//
+//   proc_reader_bench [iterations] [cpuinfo file]
+//
+// Without a file, /proc/cpuinfo and a generated 64 processor cpuinfo are
+// measured. Exits with 1 if the two parsers disagree, or if ProcReader
+// doesn't read a multi-page procfs file completely.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "proc_reader.h"
+
+using namespace zorba::system;
+
+// the parser as it was before ProcReader, kept as the baseline
+static void trim(std::string& str, char delim)
+{
+  std::string::size_type pos = str.find_last_not_of(delim);
+  if(pos != std::string::npos) {
+    str.erase(pos + 1);
+    pos = str.find_first_not_of(delim);
+    if(pos != std::string::npos) str.erase(0, pos);
+  }
+  else str.erase(str.begin(), str.end());
+}
+
+static CpuinfoCounts countProcessorsBaseline(const char* aPath)
+{
+  CpuinfoCounts lCounts;
+  std::ifstream in(aPath);
+  if(in) {
+    std::string name;
+    std::string value;
+
+    while(in) {
+      getline(in, name, ':');
+      trim (name, ' ');
+      trim (name, '\t');
+      trim (name, '\n');
+      getline(in, value);
+      trim (value, ' ');
+      trim (value, '\t');
+      if (name == "processor") {
+        lCounts.logical++;
+      }
+
+      if (name == "cpu cores") {
+        lCounts.cores = atoi(value.c_str());
+      }
+    }
+    in.close();
+    lCounts.physical = lCounts.logical/lCounts.cores;
+  }
+  return lCounts;
+}
+
+// the parser of the system module
+static CpuinfoCounts countProcessors(ProcReader& aReader, const char* aPath)
+{
+  CpuinfoCounts lCounts;
+  zorba::system::countProcessors(aReader, aPath, lCounts);
+  return lCounts;
+}
+
+static double now()
+{
+  struct timeval lTime;
+  gettimeofday(&lTime, 0);
+  return lTime.tv_sec + lTime.tv_usec / 1e6;
+}
+
+static std::string generateCpuinfo(int aProcessors)
+{
+  char lPath[] = "/tmp/cpuinfo_benchXXXXXX";
+  int lFd = mkstemp(lPath);
+  if (lFd < 0) {
+    std::perror("mkstemp");
+    std::exit(2);
+  }
+  std::ostringstream lOut;
+  for (int i = 0; i < aProcessors; ++i) {
+    lOut << "processor\t: " << i << "\n"
+         << "vendor_id\t: GenuineIntel\n"
+         << "cpu family\t: 6\n"
+         << "model\t\t: 85\n"
+         << "model name\t: Intel(R) Xeon(R) Platinum 8259CL CPU @ 2.50GHz\n"
+         << "stepping\t: 7\n"
+         << "cpu MHz\t\t: 2499.998\n"
+         << "cache size\t: 36608 KB\n"
+         << "physical id\t: " << (i / 32) << "\n"
+         << "siblings\t: 32\n"
+         << "core id\t\t: " << (i % 16) << "\n"
+         << "cpu cores\t: 16\n"
+         << "flags\t\t: fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca"
+            " cmov pat pse36 clflush mmx fxsr sse sse2 ss ht syscall nx pdpe1gb"
+            " rdtscp lm constant_tsc rep_good nopl xtopology nonstop_tsc cpuid"
+            " aperfmperf tsc_known_freq pni pclmulqdq ssse3 fma cx16 pcid sse4_1"
+            " sse4_2 x2apic movbe popcnt tsc_deadline_timer aes xsave avx f16c"
+            " rdrand hypervisor lahf_lm abm 3dnowprefetch invpcid_single pti"
+            " fsgsbase tsc_adjust bmi1 avx2 smep bmi2 erms invpcid mpx avx512f"
+            " avx512dq rdseed adx smap clflushopt clwb avx512cd avx512bw avx512vl"
+            " xsaveopt xsavec xgetbv1 xsaves ida arat pku ospke avx512_vnni\n"
+         << "bogomips\t: 4999.99\n"
+         << "address sizes\t: 46 bits physical, 48 bits virtual\n"
+         << "power management:\n\n";
+  }
+  std::string lContent = lOut.str();
+  if (write(lFd, lContent.data(), lContent.size()) != (ssize_t)lContent.size()) {
+    std::perror("write");
+    std::exit(2);
+  }
+  close(lFd);
+  return lPath;
+}
+
+// /proc/cpuinfo is a single page on hosts with few processors, so the read
+// of a procfs seq_file that spans many pages is compared separately, with
+// /proc/self/maps after adding mappings; the file must not change between
+// the two reads, so every buffer is allocated upfront
+static bool compareSeqFile()
+{
+  for (int i = 0; i < 400; ++i) {
+    // alternating protections keep the mappings from being merged
+    mmap(0, 4096, i % 2 ? PROT_READ : PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  std::vector<char> lExpected(1 << 20);
+  ProcReader lReader;
+  lReader.read("/proc/self/maps");
+
+  FILE* lFile = std::fopen("/proc/self/maps", "r");
+  if (!lFile) {
+    std::perror("/proc/self/maps");
+    return false;
+  }
+  size_t lSize = 0;
+  size_t lRead;
+  while ((lRead = std::fread(&lExpected[lSize], 1, lExpected.size() - lSize, lFile)) > 0)
+    lSize += lRead;
+  std::fclose(lFile);
+
+  if (!lReader.read("/proc/self/maps") || lReader.content().size() != lSize ||
+      memcmp(lReader.content().data(), &lExpected[0], lSize) != 0) {
+    std::fprintf(stderr, "/proc/self/maps: ProcReader read %lu bytes, fread %lu bytes\n",
+                 (unsigned long)lReader.content().size(), (unsigned long)lSize);
+    return false;
+  }
+  std::printf("%-20s %lu bytes read completely\n", "/proc/self/maps", (unsigned long)lSize);
+  return true;
+}
+
+static bool bench(const char* aName, const char* aPath, int aIterations)
+{
+  ProcReader lReader;
+  CpuinfoCounts lBaseline = countProcessorsBaseline(aPath);
+  CpuinfoCounts lCounts = countProcessors(lReader, aPath);
+  if (lBaseline.logical != lCounts.logical || lBaseline.cores != lCounts.cores ||
+      lBaseline.physical != lCounts.physical) {
+    std::fprintf(stderr, "%s: parsers disagree: baseline %d/%d/%d, ProcReader %d/%d/%d\n",
+                 aName, lBaseline.logical, lBaseline.cores, lBaseline.physical,
+                 lCounts.logical, lCounts.cores, lCounts.physical);
+    return false;
+  }
+
+  double lStart = now();
+  for (int i = 0; i < aIterations; ++i)
+    lBaseline = countProcessorsBaseline(aPath);
+  double lBaselineTime = (now() - lStart) / aIterations;
+
+  lStart = now();
+  for (int i = 0; i < aIterations; ++i)
+    lCounts = countProcessors(lReader, aPath);
+  double lTime = (now() - lStart) / aIterations;
+
+  std::printf("%-20s %4d processors  baseline %9.1f us  ProcReader %9.1f us  speedup %5.2fx\n",
+              aName, lCounts.logical, lBaselineTime * 1e6, lTime * 1e6,
+              lTime > 0 ? lBaselineTime / lTime : 0.0);
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  int lIterations = argc > 1 ? atoi(argv[1]) : 2000;
+  if (lIterations <= 0)
+    lIterations = 1;
+
+  bool lOk = true;
+  if (argc > 2) {
+    lOk = bench(argv[2], argv[2], lIterations);
+  } else {
+    lOk = compareSeqFile();
+    lOk = bench("/proc/cpuinfo", "/proc/cpuinfo", lIterations) && lOk;
+    std::string lGenerated = generateCpuinfo(64);
+    lOk = bench("generated cpuinfo", lGenerated.c_str(), lIterations) && lOk;
+    unlink(lGenerated.c_str());
+  }
+  return lOk ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2006-2008 The FLWOR Foundation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "proc_reader.h"
+
+using namespace zorba::system;
+
+static int theFailures = 0;
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n",              \
+                   __FILE__, __LINE__, #cond);                       \
+      ++theFailures;                                                 \
+    }                                                                \
+  } while (0)
+
+// writes aContent to a temporary file and returns its path
+static std::string writeFile(const std::string& aContent)
+{
+  char lPath[] = "/tmp/proc_reader_testXXXXXX";
+  int lFd = mkstemp(lPath);
+  if (lFd < 0) {
+    std::perror("mkstemp");
+    std::exit(2);
+  }
+  if (write(lFd, aContent.data(), aContent.size()) != (ssize_t)aContent.size()) {
+    std::perror("write");
+    std::exit(2);
+  }
+  close(lFd);
+  return lPath;
+}
+
+static void testStringRef()
+{
+  const char* lText = " \tprocessor : 7 \n";
+  StringRef lRef(lText, 17);
+  StringRef lTrimmed = lRef.trim();
+  CHECK(lTrimmed == "processor : 7");
+  CHECK(lTrimmed != "processor");
+  CHECK(lTrimmed.startsWith("proc"));
+  CHECK(!lTrimmed.startsWith("processor : 77"));
+  CHECK(lTrimmed.find(':') == 10);
+  CHECK(lTrimmed.find('#') == StringRef::npos);
+  CHECK(lTrimmed.substr(12) == "7");
+  CHECK(lTrimmed.substr(0, 4).str() == "proc");
+  CHECK(lTrimmed.substr(100).empty());
+  CHECK(StringRef("   ", 3).trim().empty());
+
+  long lValue = 0;
+  CHECK(StringRef("4096 kB", 7).toLong(lValue) && lValue == 4096);
+  CHECK(StringRef("-3", 2).toLong(lValue) && lValue == -3);
+  CHECK(!StringRef("kB", 2).toLong(lValue));
+  CHECK(!StringRef("-", 1).toLong(lValue));
+  CHECK(!StringRef().toLong(lValue));
+}
+
+static void testKeyValue()
+{
+  std::string lPath = writeFile(
+      "processor\t: 0\n"
+      "cpu cores\t: 4\n"
+      "\n"
+      "flags\t\t: fpu vme de\n"
+      "no separator\n"
+      "processor\t: 1");
+  ProcReader lReader;
+  CHECK(lReader.read(lPath.c_str()));
+  CHECK(lReader.content().startsWith("processor"));
+
+  StringRef lKey, lValue;
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "processor" && lValue == "0");
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "cpu cores" && lValue == "4");
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey.empty() && lValue.empty());
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "flags" && lValue == "fpu vme de");
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "no separator" && lValue.empty());
+  // the last line has no line break
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "processor" && lValue == "1");
+  CHECK(!lReader.nextKeyValue(':', lKey, lValue));
+
+  unlink(lPath.c_str());
+}
+
+static void testColumns()
+{
+  std::string lPath = writeFile(
+      "MemTotal:       16314576 kB\n"
+      "  \t\n"
+      "cpu  10132153 290696 3084719\n");
+  ProcReader lReader;
+  CHECK(lReader.read(lPath.c_str()));
+
+  StringRef lLine, lColumn;
+  long lValue = 0;
+  CHECK(lReader.nextLine(lLine));
+  CHECK(ProcReader::nextColumn(lLine, lColumn) && lColumn == "MemTotal:");
+  CHECK(ProcReader::nextColumn(lLine, lColumn) && lColumn.toLong(lValue) && lValue == 16314576);
+  CHECK(ProcReader::nextColumn(lLine, lColumn) && lColumn == "kB");
+  CHECK(!ProcReader::nextColumn(lLine, lColumn));
+  CHECK(lLine.empty());
+
+  CHECK(lReader.nextLine(lLine));
+  CHECK(!ProcReader::nextColumn(lLine, lColumn));
+
+  CHECK(lReader.nextLine(lLine));
+  int lColumns = 0;
+  while (ProcReader::nextColumn(lLine, lColumn))
+    ++lColumns;
+  CHECK(lColumns == 4);
+  CHECK(!lReader.nextLine(lLine));
+
+  unlink(lPath.c_str());
+}
+
+static void testLargeFile()
+{
+  // larger than the initial buffer, so read() has to grow it
+  std::string lContent;
+  for (int i = 0; i < 2000; ++i)
+    lContent += "processor\t: 0\n";
+  std::string lPath = writeFile(lContent);
+  ProcReader lReader;
+  CHECK(lReader.read(lPath.c_str()));
+  CHECK(lReader.content().size() == lContent.size());
+
+  int lLines = 0;
+  StringRef lKey, lValue;
+  while (lReader.nextKeyValue(':', lKey, lValue))
+    ++lLines;
+  CHECK(lLines == 2000);
+
+  // reading again resets the position
+  CHECK(lReader.read(lPath.c_str()));
+  CHECK(lReader.nextKeyValue(':', lKey, lValue) && lKey == "processor");
+
+  unlink(lPath.c_str());
+  CHECK(!lReader.read(lPath.c_str()));
+  CHECK(lReader.content().empty());
+}
+
+static void testPipe()
+{
+  int lFds[2];
+  CHECK(pipe(lFds) == 0);
+  const char lOutput[] = "Distributor ID:\tDebian\nRelease:\t12\n";
+  CHECK(write(lFds[1], lOutput, sizeof(lOutput) - 1) == (ssize_t)(sizeof(lOutput) - 1));
+  close(lFds[1]);
+
+  ProcReader lReader;
+  CHECK(lReader.read(lFds[0]));
+  close(lFds[0]);
+  StringRef lKey, lValue;
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "Distributor ID" && lValue == "Debian");
+  CHECK(lReader.nextKeyValue(':', lKey, lValue));
+  CHECK(lKey == "Release" && lValue == "12");
+  CHECK(!lReader.nextKeyValue(':', lKey, lValue));
+}
+
+static void testSeqFile()
+{
+  // seq_files return short reads long before their end; with 400 more
+  // mappings, /proc/self/maps spans several pages
+  for (int i = 0; i < 400; ++i) {
+    // alternating protections keep the mappings from being merged
+    mmap(0, 4096, i % 2 ? PROT_READ : PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  }
+  // allocate every buffer before reading, such that the maps don't change
+  std::vector<char> lExpected(1 << 20);
+  ProcReader lReader;
+  CHECK(lReader.read("/proc/self/maps"));
+
+  FILE* lFile = std::fopen("/proc/self/maps", "r");
+  CHECK(lFile != 0);
+  if (!lFile)
+    return;
+  size_t lSize = 0;
+  size_t lRead;
+  while ((lRead = std::fread(&lExpected[lSize], 1, lExpected.size() - lSize, lFile)) > 0)
+    lSize += lRead;
+  std::fclose(lFile);
+
+  CHECK(lSize > 4096);
+  CHECK(lReader.read("/proc/self/maps"));
+  CHECK(lReader.content().size() == lSize);
+  CHECK(memcmp(lReader.content().data(), &lExpected[0], lSize) == 0);
+}
+
+static void testCountProcessors()
+{
+  std::string lContent;
+  for (int i = 0; i < 8; ++i)
+    lContent += "processor\t: 0\nmodel name\t: Test CPU\ncpu cores\t: 4\n\n";
+  std::string lPath = writeFile(lContent);
+  ProcReader lReader;
+  CpuinfoCounts lCounts;
+  CHECK(countProcessors(lReader, lPath.c_str(), lCounts));
+  CHECK(lCounts.logical == 8);
+  CHECK(lCounts.cores == 4);
+  CHECK(lCounts.physical == 2);
+  unlink(lPath.c_str());
+
+  // single core processor per default
+  lPath = writeFile("processor\t: 0\n");
+  lCounts = CpuinfoCounts();
+  CHECK(countProcessors(lReader, lPath.c_str(), lCounts));
+  CHECK(lCounts.logical == 1 && lCounts.cores == 1 && lCounts.physical == 1);
+  unlink(lPath.c_str());
+  CHECK(!countProcessors(lReader, lPath.c_str(), lCounts));
+}
+
+int main()
+{
+  testStringRef();
+  testKeyValue();
+  testColumns();
+  testLargeFile();
+  testPipe();
+  testSeqFile();
+  testCountProcessors();
+  if (theFailures) {
+    std::fprintf(stderr, "%d check(s) failed\n", theFailures);
+    return 1;
+  }
+  return 0;
+}